@@ -1,11 +1,23 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/Graphics/Rect.hpp>
 #include <algorithm>
+#include <cctype>
+#include <cerrno>
 #include <cmath>
+#include <condition_variable>
 #include <cstdlib>
 #include <ctime>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 std::mutex lightMutex;
@@ -74,6 +86,16 @@ public:
   }
 };
 
+// Grow rect so that it also covers other
+void expandRect(sf::FloatRect &rect, const sf::FloatRect &other) {
+  float right = std::max(rect.left + rect.width, other.left + other.width);
+  float bottom = std::max(rect.top + rect.height, other.top + other.height);
+  rect.left = std::min(rect.left, other.left);
+  rect.top = std::min(rect.top, other.top);
+  rect.width = right - rect.left;
+  rect.height = bottom - rect.top;
+}
+
 class Lane {
 public:
   sf::RectangleShape shape;
@@ -84,6 +106,10 @@ public:
   bool ignoreTrafficLight;
   bool isPriority;
   int waitingVehicles;
+  // Area covered by the lane and every car it owns. Cars keep belonging to
+  // their lane after turning, so they can be well outside the lane shape.
+  // Refreshed by updateCars(), which already visits every car.
+  sf::FloatRect extent;
 
   Lane(float x, float y, float width, float height, sf::Color color,
        sf::Color carColor, TrafficLight *trafficLight,
@@ -95,6 +121,7 @@ public:
     shape.setFillColor(color);
     this->carColor = carColor;
     this->trafficLight = trafficLight;
+    extent = shape.getGlobalBounds();
   }
 
   void addCar(const Car &car) {
@@ -111,12 +138,14 @@ public:
     }
 
     cars.push_back(newCar);
+    expandRect(extent, newCar.shape.getGlobalBounds());
   }
 
   void updateCars() {
     const float stopThreshold = 10.0f;  // Distance threshold before stopping
     const float collisionBuffer = 8.0f; // Minimum distance between cars
 
+    extent = shape.getGlobalBounds();
     for (auto it = cars.begin(); it != cars.end();) {
       bool shouldMove = true;
       sf::Vector2f carPos = it->shape.getPosition();
@@ -219,6 +248,7 @@ public:
       } else {
         it->stopped = true;
       }
+      expandRect(extent, it->shape.getGlobalBounds());
 
       if (it->isOutOfBounds(720, 600)) {
         it = cars.erase(it);
@@ -280,9 +310,145 @@ public:
     }
   }
 
-  void drawCars(sf::RenderWindow &window) {
+  // Draw only the cars that overlap the visible part of the map
+  void drawCars(sf::RenderWindow &window, const sf::FloatRect &visibleRegion) {
     for (auto &car : cars) {
-      window.draw(car.shape);
+      if (car.shape.getGlobalBounds().intersects(visibleRegion))
+        window.draw(car.shape);
+    }
+  }
+
+  // Zoomed-out stand-in for drawCars: one bar per lane, growing back from the
+  // traffic light in proportion to the queue. Uses waitingVehicles, so cars
+  // that have already crossed and moving traffic do not count. Lanes that
+  // ignore the light only queue behind a blocked car at the crossing, so
+  // their bar grows back from the same end.
+  void drawDensity(sf::RenderWindow &window) {
+    const float carSpacing = 28.0f; // Car length plus collision buffer
+
+    sf::Vector2f lanePos = shape.getPosition();
+    sf::Vector2f laneSize = shape.getSize();
+    sf::FloatRect lightBounds = trafficLight->shape.getGlobalBounds();
+    bool horizontal = laneSize.x > laneSize.y;
+    float length = horizontal ? laneSize.x : laneSize.y;
+    float density = std::min(1.0f, waitingVehicles * carSpacing / length);
+    float barLength = length * density;
+
+    sf::RectangleShape bar;
+    bar.setFillColor(carColor);
+    if (horizontal) {
+      bool lightOnRight =
+          lightBounds.left + lightBounds.width / 2 > lanePos.x + length / 2;
+      bar.setSize(sf::Vector2f(barLength, laneSize.y));
+      bar.setPosition(lightOnRight ? lanePos.x + length - barLength : lanePos.x,
+                      lanePos.y);
+    } else {
+      bool lightBelow =
+          lightBounds.top + lightBounds.height / 2 > lanePos.y + length / 2;
+      bar.setSize(sf::Vector2f(laneSize.x, barLength));
+      bar.setPosition(lanePos.x,
+                      lightBelow ? lanePos.y + length - barLength : lanePos.y);
+    }
+    window.draw(bar);
+  }
+};
+
+// Uniform grid over lane extents, used to find the lanes that can have
+// anything on screen without testing every car in the network.
+class LaneGrid {
+public:
+  explicit LaneGrid(float cellSize = 100.0f) : cellSize(cellSize) {}
+
+  // Re-register lanes whose extent has moved into a different set of cells.
+  // Costs one check per lane; the cells themselves rarely change.
+  void update(const std::vector<Lane *> &lanes) {
+    bool changed = false;
+    for (auto lane : lanes) {
+      CellRange range = cellRange(lane->extent);
+      auto found = registered.find(lane);
+      if (found != registered.end()) {
+        if (found->second == range)
+          continue;
+        forEachCell(found->second, [&](long long key) {
+          std::vector<Lane *> &cell = cells[key];
+          cell.erase(std::remove(cell.begin(), cell.end(), lane), cell.end());
+          if (cell.empty())
+            cells.erase(key);
+        });
+      }
+      forEachCell(range, [&](long long key) { cells[key].push_back(lane); });
+      registered[lane] = range;
+      changed = true;
+    }
+    if (changed)
+      updateOccupiedArea();
+  }
+
+  // Lanes whose extent may overlap region, each listed once
+  std::vector<Lane *> query(const sf::FloatRect &region) const {
+    std::vector<Lane *> result;
+
+    // Only look at cells that can hold a lane. However far the view is
+    // zoomed out, this keeps the work bounded by the map and keeps the cell
+    // coordinates within int range.
+    sf::FloatRect clipped;
+    if (registered.empty() || !region.intersects(occupiedArea, clipped))
+      return result;
+
+    forEachCell(cellRange(clipped), [&](long long key) {
+      auto cell = cells.find(key);
+      if (cell == cells.end())
+        return;
+      for (auto lane : cell->second) {
+        if (std::find(result.begin(), result.end(), lane) == result.end())
+          result.push_back(lane);
+      }
+    });
+    return result;
+  }
+
+private:
+  struct CellRange {
+    int x0, y0, x1, y1;
+
+    bool operator==(const CellRange &other) const {
+      return x0 == other.x0 && y0 == other.y0 && x1 == other.x1 &&
+             y1 == other.y1;
+    }
+  };
+
+  float cellSize;
+  std::unordered_map<long long, std::vector<Lane *>> cells;
+  std::unordered_map<Lane *, CellRange> registered;
+  sf::FloatRect occupiedArea; // Union of every registered cell
+
+  void updateOccupiedArea() {
+    CellRange bounds = registered.begin()->second;
+    for (auto &entry : registered) {
+      bounds.x0 = std::min(bounds.x0, entry.second.x0);
+      bounds.y0 = std::min(bounds.y0, entry.second.y0);
+      bounds.x1 = std::max(bounds.x1, entry.second.x1);
+      bounds.y1 = std::max(bounds.y1, entry.second.y1);
+    }
+    occupiedArea = sf::FloatRect(bounds.x0 * cellSize, bounds.y0 * cellSize,
+                                 (bounds.x1 - bounds.x0 + 1) * cellSize,
+                                 (bounds.y1 - bounds.y0 + 1) * cellSize);
+  }
+
+  CellRange cellRange(const sf::FloatRect &rect) const {
+    return {(int)std::floor(rect.left / cellSize),
+            (int)std::floor(rect.top / cellSize),
+            (int)std::floor((rect.left + rect.width) / cellSize),
+            (int)std::floor((rect.top + rect.height) / cellSize)};
+  }
+
+  template <typename Visit>
+  void forEachCell(const CellRange &range, Visit visit) const {
+    for (int y = range.y0; y <= range.y1; y++) {
+      for (int x = range.x0; x <= range.x1; x++) {
+        visit((long long)(((unsigned long long)(unsigned int)x << 32) |
+                          (unsigned int)y));
+      }
     }
   }
 };
@@ -361,55 +527,72 @@ bool anyCarInRegion(const std::vector<Lane *> &lanes,
   return false;
 }
 
-int main() {
-  sf::RenderWindow window(sf::VideoMode(800, 600), "Traffic Light Simulator");
-  window.setFramerateLimit(300);
-
-  sf::Font font;
-  if (!font.loadFromFile(
-          "/usr/share/fonts/abattis-cantarell-fonts/Cantarell-Light.otf")) {
-    std::cerr << "Error loading font\n";
-    return -1;
+// Fill a rectangle into an RGBA pixel buffer, clipped to the buffer size.
+// Used to rasterize frames without an OpenGL context.
+void fillRect(std::vector<sf::Uint8> &pixels, unsigned width, unsigned height,
+              const sf::FloatRect &rect, const sf::Color &color) {
+  int x0 = std::max(0, (int)std::lround(rect.left));
+  int y0 = std::max(0, (int)std::lround(rect.top));
+  int x1 = std::min((int)width, (int)std::lround(rect.left + rect.width));
+  int y1 = std::min((int)height, (int)std::lround(rect.top + rect.height));
+  if (x0 >= x1)
+    return; // Entirely off to one side; no row has anything to fill
+
+  for (int y = y0; y < y1; y++) {
+    sf::Uint8 *pixel = &pixels[(y * width + x0) * 4];
+    for (int x = x0; x < x1; x++) {
+      pixel[0] = color.r;
+      pixel[1] = color.g;
+      pixel[2] = color.b;
+      pixel[3] = color.a;
+      pixel += 4;
+    }
   }
+}
 
+// A single four-way crossing: its roads, lights, lanes and signal state.
+// Everything the simulation needs for one intersection lives here so that a
+// crossing can be stepped and drawn as a unit, independent of the window.
+class Intersection {
+public:
   // Create roads
-  Road roadA(100, 250, 400, 120);
-  Road roadB(470, 250, 250, 120);
-  Road roadC(350, 000, 120, 400);
-  Road roadD(350, 370, 120, 400);
+  Road roadA{100, 250, 400, 120};
+  Road roadB{470, 250, 250, 120};
+  Road roadC{350, 000, 120, 400};
+  Road roadD{350, 370, 120, 400};
 
   // Create traffic lights (we control their states via priority check)
-  TrafficLight trafficLight1(470, 250, 25, 120); // Right side
-  TrafficLight trafficLight2(325, 250, 25, 120); // Left side
-  TrafficLight trafficLight3(350, 225, 120, 25); // Top side
-  TrafficLight trafficLight4(350, 370, 120, 25); // Bottom side
+  TrafficLight trafficLight1{470, 250, 25, 120}; // Right side
+  TrafficLight trafficLight2{325, 250, 25, 120}; // Left side
+  TrafficLight trafficLight3{350, 225, 120, 25}; // Top side
+  TrafficLight trafficLight4{350, 370, 120, 25}; // Bottom side
 
   // Create lanes
   // Horizontal lanes: left side (trafficLight2) and right side (trafficLight1)
-  Lane lane1(100, 260, 250, 20, sf::Color::White, sf::Color(125, 5, 82),
-             &trafficLight2, true, true); // left priority lane
-  Lane lane2(100, 290, 250, 40, sf::Color::White, sf::Color(125, 5, 82),
-             &trafficLight2);
-  Lane lane3(100, 340, 250, 20, sf::Color::White, sf::Color(125, 5, 82),
-             &trafficLight2);
-  Lane lane7(470, 260, 250, 20, sf::Color::White, sf::Color(210, 145, 188),
-             &trafficLight1); // right
-  Lane lane8(470, 290, 250, 40, sf::Color::White, sf::Color(210, 145, 188),
-             &trafficLight1);
-  Lane lane9(470, 340, 250, 20, sf::Color::White, sf::Color(210, 145, 188),
-             &trafficLight1, true);
-  Lane lane4(360, 000, 20, 250, sf::Color::White, sf::Color::Blue,
-             &trafficLight3); // top
-  Lane lane5(390, 000, 40, 250, sf::Color::White, sf::Color::Blue,
-             &trafficLight3);
-  Lane lane6(440, 000, 20, 250, sf::Color::White, sf::Color::Blue,
-             &trafficLight3, true);
-  Lane lane10(440, 370, 20, 250, sf::Color::White, sf::Color::Black,
-              &trafficLight4, true, true); // bottom priority lane
-  Lane lane11(390, 370, 40, 250, sf::Color::White, sf::Color::Black,
-              &trafficLight4);
-  Lane lane12(360, 370, 20, 250, sf::Color::White, sf::Color::Black,
-              &trafficLight4, true);
+  Lane lane1{100, 260, 250, 20, sf::Color::White, sf::Color(125, 5, 82),
+             &trafficLight2, true, true}; // left priority lane
+  Lane lane2{100, 290, 250, 40, sf::Color::White, sf::Color(125, 5, 82),
+             &trafficLight2};
+  Lane lane3{100, 340, 250, 20, sf::Color::White, sf::Color(125, 5, 82),
+             &trafficLight2};
+  Lane lane7{470, 260, 250, 20, sf::Color::White, sf::Color(210, 145, 188),
+             &trafficLight1}; // right
+  Lane lane8{470, 290, 250, 40, sf::Color::White, sf::Color(210, 145, 188),
+             &trafficLight1};
+  Lane lane9{470, 340, 250, 20, sf::Color::White, sf::Color(210, 145, 188),
+             &trafficLight1, true};
+  Lane lane4{360, 000, 20, 250, sf::Color::White, sf::Color::Blue,
+             &trafficLight3}; // top
+  Lane lane5{390, 000, 40, 250, sf::Color::White, sf::Color::Blue,
+             &trafficLight3};
+  Lane lane6{440, 000, 20, 250, sf::Color::White, sf::Color::Blue,
+             &trafficLight3, true};
+  Lane lane10{440, 370, 20, 250, sf::Color::White, sf::Color::Black,
+              &trafficLight4, true, true}; // bottom priority lane
+  Lane lane11{390, 370, 40, 250, sf::Color::White, sf::Color::Black,
+              &trafficLight4};
+  Lane lane12{360, 370, 20, 250, sf::Color::White, sf::Color::Black,
+              &trafficLight4, true};
 
   // Group lanes by side for priority checking.
   std::vector<Lane *> leftLanes = {&lane1, &lane2, &lane3};
@@ -428,20 +611,21 @@ int main() {
   // Timing variables
   float greenTimer = 0.0f;
   float greenDuration = 0.0f;
-  const float frameTime = 1.0f / 300.0f; // Based on framerate limit
 
-  std::srand(std::time(nullptr));
+  // Spatial index used to cull off-screen lanes when drawing
+  LaneGrid laneGrid;
 
-  while (window.isOpen()) {
-    sf::Event event;
-    while (window.pollEvent(event)) {
-      if (event.type == sf::Event::Closed)
-        window.close();
-      if (event.type == sf::Event::KeyPressed &&
-          event.key.code == sf::Keyboard::Q)
-        window.close();
-    }
+  // Above this many world units per pixel cars are drawn as density bars
+  static constexpr float densityZoomThreshold = 2.0f;
+
+  Intersection() = default;
 
+  // Lanes hold pointers to the lights and the groups hold pointers to the
+  // lanes, so an intersection must stay where it was built.
+  Intersection(const Intersection &) = delete;
+  Intersection &operator=(const Intersection &) = delete;
+
+  void spawnCars() {
     // Spawn cars randomly (2% chance per frame)
     if (std::rand() % 100 < 2) {
       int side = std::rand() % 4;
@@ -491,7 +675,10 @@ int main() {
         }
       }
     }
+  }
 
+  // Advance the crossing by one simulation tick of frameTime seconds.
+  void update(float frameTime) {
     // Update waiting counts for all lanes
     for (auto lane : allLanes) {
       lane->updateWaitingCount();
@@ -512,9 +699,6 @@ int main() {
     }
 
     // === PRIORITY CHECK ===
-    // Define the base intersection region where cars are considered waiting.
-    sf::FloatRect intersectionRegion(350, 250, 100, 100);
-
     // Check for priority lanes with more than 5 waiting vehicles
     Lane *priorityLane = nullptr;
     for (auto lane : allLanes) {
@@ -524,40 +708,6 @@ int main() {
       }
     }
 
-    // Determine active traffic light and lanes based on current priority.
-    TrafficLight *activeTrafficLight = nullptr;
-    std::vector<Lane *> *activeLanes = nullptr;
-    if (currentPriority == Side::LEFT) {
-      activeTrafficLight = &trafficLight2;
-      activeLanes = &leftLanes;
-    } else if (currentPriority == Side::RIGHT) {
-      activeTrafficLight = &trafficLight1;
-      activeLanes = &rightLanes;
-    } else if (currentPriority == Side::TOP) {
-      activeTrafficLight = &trafficLight3;
-      activeLanes = &topLanes;
-    } else if (currentPriority == Side::BOTTOM) {
-      activeTrafficLight = &trafficLight4;
-      activeLanes = &bottomLanes;
-    }
-
-    // Compute the extended region as the union of the base intersection
-    // region and the active traffic light's bounds.
-    sf::FloatRect extendedRegion = intersectionRegion;
-    if (activeTrafficLight != nullptr) {
-      sf::FloatRect lightBounds = activeTrafficLight->shape.getGlobalBounds();
-      extendedRegion.left = std::min(intersectionRegion.left, lightBounds.left);
-      extendedRegion.top = std::min(intersectionRegion.top, lightBounds.top);
-      extendedRegion.width =
-          std::max(intersectionRegion.left + intersectionRegion.width,
-                   lightBounds.left + lightBounds.width) -
-          extendedRegion.left;
-      extendedRegion.height =
-          std::max(intersectionRegion.top + intersectionRegion.height,
-                   lightBounds.top + lightBounds.height) -
-          extendedRegion.top;
-    }
-
     // If a priority lane needs service and no current priority, give it
     // priority
     if (currentPriority == Side::NONE && priorityLane != nullptr) {
@@ -679,44 +829,350 @@ int main() {
       trafficLight4.shape.setFillColor(
           trafficLight4.colors[trafficLight4.state]);
     }
+  }
+
+  void draw(sf::RenderWindow &window) {
+    const sf::View &view = window.getView();
+    sf::FloatRect visibleRegion(view.getCenter() - view.getSize() * 0.5f,
+                                view.getSize());
+    float unitsPerPixel = view.getSize().x / window.getSize().x;
+
+    std::lock_guard<std::mutex> lock(lightMutex);
+    window.draw(roadA.shape);
+    window.draw(roadB.shape);
+    window.draw(roadC.shape);
+    window.draw(roadD.shape);
+    for (auto lane : allLanes) {
+      window.draw(lane->shape);
+    }
+    window.draw(trafficLight1.shape);
+    window.draw(trafficLight2.shape);
+    window.draw(trafficLight3.shape);
+    window.draw(trafficLight4.shape);
+
+    laneGrid.update(allLanes);
+    for (auto lane : laneGrid.query(visibleRegion)) {
+      if (unitsPerPixel > densityZoomThreshold)
+        lane->drawDensity(window);
+      else
+        lane->drawCars(window, visibleRegion);
+    }
+  }
+
+  // Produce the same picture as draw() straight from the simulation state.
+  // Every shape is an unrotated rectangle, so no window or GPU is needed.
+  void rasterize(std::vector<sf::Uint8> &pixels, unsigned width,
+                 unsigned height) {
+    std::lock_guard<std::mutex> lock(lightMutex);
+    fillRect(pixels, width, height, sf::FloatRect(0, 0, width, height),
+             sf::Color::Black);
+    fillRect(pixels, width, height, roadA.shape.getGlobalBounds(),
+             roadA.shape.getFillColor());
+    fillRect(pixels, width, height, roadB.shape.getGlobalBounds(),
+             roadB.shape.getFillColor());
+    fillRect(pixels, width, height, roadC.shape.getGlobalBounds(),
+             roadC.shape.getFillColor());
+    fillRect(pixels, width, height, roadD.shape.getGlobalBounds(),
+             roadD.shape.getFillColor());
+    for (auto lane : allLanes) {
+      fillRect(pixels, width, height, lane->shape.getGlobalBounds(),
+               lane->shape.getFillColor());
+    }
+    for (auto light :
+         {&trafficLight1, &trafficLight2, &trafficLight3, &trafficLight4}) {
+      fillRect(pixels, width, height, light->shape.getGlobalBounds(),
+               light->shape.getFillColor());
+    }
+    for (auto lane : allLanes) {
+      for (auto &car : lane->cars) {
+        fillRect(pixels, width, height, car.shape.getGlobalBounds(),
+                 car.shape.getFillColor());
+      }
+    }
+  }
+};
+
+// Writes captured frames to disk on a background thread.
+// Frames are rendered into a fixed pool of reusable pixel buffers. When the
+// writer falls behind and the pool runs dry, an interactive run drops the
+// frame rather than stalling the window; a headless run waits for the writer.
+// Files are numbered in capture order, so dropped frames leave no gaps.
+class FrameRecorder {
+public:
+  FrameRecorder(const std::string &directory, bool rawFormat, unsigned width,
+                unsigned height, bool dropWhenBusy, std::size_t poolSize = 16)
+      : directory(directory), rawFormat(rawFormat), width(width),
+        height(height), dropWhenBusy(dropWhenBusy), capturedFrames(0),
+        droppedFrames(0), stopping(false) {
+    buffers.resize(poolSize, std::vector<sf::Uint8>(width * height * 4));
+    for (auto &buffer : buffers) {
+      freeBuffers.push_back(&buffer);
+    }
+    writer = std::thread(&FrameRecorder::writeFrames, this);
+  }
 
+  FrameRecorder(const FrameRecorder &) = delete;
+  FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+  ~FrameRecorder() {
     {
-      std::lock_guard<std::mutex> lock(lightMutex);
-      window.clear();
-      window.draw(roadA.shape);
-      window.draw(roadB.shape);
-      window.draw(roadC.shape);
-      window.draw(roadD.shape);
-      window.draw(lane1.shape);
-      window.draw(lane2.shape);
-      window.draw(lane3.shape);
-      window.draw(lane4.shape);
-      window.draw(lane5.shape);
-      window.draw(lane6.shape);
-      window.draw(lane7.shape);
-      window.draw(lane8.shape);
-      window.draw(lane9.shape);
-      window.draw(lane10.shape);
-      window.draw(lane11.shape);
-      window.draw(lane12.shape);
-      window.draw(trafficLight1.shape);
-      window.draw(trafficLight2.shape);
-      window.draw(trafficLight3.shape);
-      window.draw(trafficLight4.shape);
-      lane1.drawCars(window);
-      lane2.drawCars(window);
-      lane3.drawCars(window);
-      lane4.drawCars(window);
-      lane5.drawCars(window);
-      lane6.drawCars(window);
-      lane7.drawCars(window);
-      lane8.drawCars(window);
-      lane9.drawCars(window);
-      lane10.drawCars(window);
-      lane11.drawCars(window);
-      lane12.drawCars(window);
-      window.display();
+      std::lock_guard<std::mutex> lock(queueMutex);
+      stopping = true;
+    }
+    queueReady.notify_one();
+    writer.join(); // Flushes every frame that was already queued
+
+    std::cout << "Recorded " << capturedFrames << " frames to " << directory
+              << "\n";
+    if (droppedFrames > 0) {
+      std::cerr << "Warning: dropped " << droppedFrames
+                << " frames because the writer fell behind\n";
+    }
+  }
+
+  // Rasterize the intersection into a free buffer and queue it for writing.
+  // If no buffer is free, either drop the frame or wait for the writer.
+  void capture(Intersection &intersection) {
+    std::vector<sf::Uint8> *buffer = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      if (freeBuffers.empty() && dropWhenBusy) {
+        droppedFrames++;
+        return;
+      }
+      bufferFreed.wait(lock, [this] { return !freeBuffers.empty(); });
+      buffer = freeBuffers.back();
+      freeBuffers.pop_back();
+    }
+
+    intersection.rasterize(*buffer, width, height);
+
+    {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      pendingFrames.push_back({capturedFrames++, buffer});
+    }
+    queueReady.notify_one();
+  }
+
+private:
+  struct PendingFrame {
+    unsigned long frameNumber;
+    std::vector<sf::Uint8> *pixels;
+  };
+
+  std::string directory;
+  bool rawFormat;
+  unsigned width, height;
+  bool dropWhenBusy;
+  std::vector<std::vector<sf::Uint8>> buffers;
+  std::vector<std::vector<sf::Uint8> *> freeBuffers;
+  std::deque<PendingFrame> pendingFrames;
+  std::mutex queueMutex;
+  std::condition_variable queueReady;
+  std::condition_variable bufferFreed;
+  std::thread writer;
+  unsigned long capturedFrames;
+  int droppedFrames;
+  bool stopping;
+
+  void writeFrames() {
+    while (true) {
+      PendingFrame frame;
+      {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueReady.wait(lock,
+                        [this] { return stopping || !pendingFrames.empty(); });
+        if (pendingFrames.empty())
+          return; // Stopping and nothing left to write
+        frame = pendingFrames.front();
+        pendingFrames.pop_front();
+      }
+
+      writeFrame(frame);
+
+      {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        freeBuffers.push_back(frame.pixels);
+      }
+      bufferFreed.notify_one();
+    }
+  }
+
+  void writeFrame(const PendingFrame &frame) {
+    std::ostringstream path;
+    path << directory << "/frame_" << std::setw(6) << std::setfill('0')
+         << frame.frameNumber << (rawFormat ? ".rgba" : ".png");
+
+    bool written = false;
+    if (rawFormat) {
+      std::ofstream file(path.str(), std::ios::binary);
+      file.write(reinterpret_cast<const char *>(frame.pixels->data()),
+                 frame.pixels->size());
+      written = file.good();
+    } else {
+      sf::Image image;
+      image.create(width, height, frame.pixels->data());
+      written = image.saveToFile(path.str());
+    }
+    if (!written) {
+      std::cerr << "Error writing " << path.str() << "\n";
+    }
+  }
+};
+
+int main(int argc, char *argv[]) {
+  const unsigned windowWidth = 800;
+  const unsigned windowHeight = 600;
+
+  // Capture every 10th tick: 30 frames per simulated second at 300 ticks.
+  const unsigned long captureInterval = 10;
+
+  std::string recordDirectory;
+  bool rawFrames = false;
+  bool headless = false;
+  unsigned long headlessTicks = 300 * 60; // One simulated minute
+  bool ticksGiven = false;
+
+  const std::string usage = std::string("Usage: ") + argv[0] +
+                            " [--record DIR [--raw]] [--headless [--ticks N]]\n";
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--record" && i + 1 < argc) {
+      recordDirectory = argv[++i];
+    } else if (arg == "--raw") {
+      rawFrames = true;
+    } else if (arg == "--headless") {
+      headless = true;
+    } else if (arg == "--ticks" && i + 1 < argc) {
+      const char *value = argv[++i];
+      char *end = nullptr;
+      errno = 0;
+      headlessTicks = std::strtoul(value, &end, 10);
+      if (!std::isdigit((unsigned char)value[0]) || *end != '\0' ||
+          errno == ERANGE || headlessTicks == 0) {
+        std::cerr << "Error: --ticks needs a positive whole number, got \""
+                  << value << "\"\n";
+        return -1;
+      }
+      ticksGiven = true;
+    } else {
+      std::cerr << usage;
+      return -1;
+    }
+  }
+
+  // Reject options that would otherwise be silently ignored
+  if (rawFrames && recordDirectory.empty()) {
+    std::cerr << "Error: --raw only applies with --record\n" << usage;
+    return -1;
+  }
+  if (ticksGiven && !headless) {
+    std::cerr << "Error: --ticks only applies with --headless\n" << usage;
+    return -1;
+  }
+  if (headless && recordDirectory.empty()) {
+    std::cerr << "Error: --headless produces no output without --record\n"
+              << usage;
+    return -1;
+  }
+
+  std::unique_ptr<FrameRecorder> recorder;
+  if (!recordDirectory.empty()) {
+    std::error_code error;
+    std::filesystem::create_directories(recordDirectory, error);
+    if (error) {
+      std::cerr << "Error creating " << recordDirectory << ": "
+                << error.message() << "\n";
+      return -1;
+    }
+    // Only an interactive run has a frame rate to protect; headless runs
+    // wait for the writer so that no frames are lost.
+    recorder = std::make_unique<FrameRecorder>(
+        recordDirectory, rawFrames, windowWidth, windowHeight, !headless);
+  }
+
+  Intersection intersection;
+
+  const float frameTime = 1.0f / 300.0f; // Based on framerate limit
+
+  std::srand(std::time(nullptr));
+
+  // Headless runs step the simulation as fast as possible with no window.
+  // Timing is unaffected because every tick advances by frameTime.
+  if (headless) {
+    for (unsigned long tick = 0; tick < headlessTicks; tick++) {
+      intersection.spawnCars();
+      intersection.update(frameTime);
+      if (recorder && tick % captureInterval == 0)
+        recorder->capture(intersection);
     }
+    return 0;
+  }
+
+  sf::RenderWindow window(sf::VideoMode(windowWidth, windowHeight),
+                          "Traffic Light Simulator");
+  window.setFramerateLimit(300);
+
+  sf::Font font;
+  if (!font.loadFromFile(
+          "/usr/share/fonts/abattis-cantarell-fonts/Cantarell-Light.otf")) {
+    std::cerr << "Error loading font\n";
+    return -1;
+  }
+
+  // Pannable, zoomable camera over the map
+  sf::View view = window.getDefaultView();
+  const float panStep = 20.0f;  // Pixels per arrow key press
+  const float zoomStep = 1.1f;  // Scale per mouse wheel notch
+  const float minZoom = 0.25f;  // View size relative to the window
+  const float maxZoom = 8.0f;
+
+  unsigned long tick = 0;
+  while (window.isOpen()) {
+    sf::Event event;
+    while (window.pollEvent(event)) {
+      if (event.type == sf::Event::Closed)
+        window.close();
+      if (event.type == sf::Event::KeyPressed &&
+          event.key.code == sf::Keyboard::Q)
+        window.close();
+
+      if (event.type == sf::Event::KeyPressed) {
+        // Pan by a fixed number of screen pixels at any zoom level
+        float step = panStep * view.getSize().x / windowWidth;
+        if (event.key.code == sf::Keyboard::Left)
+          view.move(-step, 0);
+        else if (event.key.code == sf::Keyboard::Right)
+          view.move(step, 0);
+        else if (event.key.code == sf::Keyboard::Up)
+          view.move(0, -step);
+        else if (event.key.code == sf::Keyboard::Down)
+          view.move(0, step);
+        else if (event.key.code == sf::Keyboard::Home)
+          view = window.getDefaultView();
+      }
+      if (event.type == sf::Event::MouseWheelScrolled &&
+          event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel) {
+        float factor =
+            event.mouseWheelScroll.delta > 0 ? 1.0f / zoomStep : zoomStep;
+        float zoomLevel = std::clamp(view.getSize().x * factor / windowWidth,
+                                     minZoom, maxZoom);
+        view.setSize(windowWidth * zoomLevel, windowHeight * zoomLevel);
+      }
+    }
+    window.setView(view);
+
+    intersection.spawnCars();
+    intersection.update(frameTime);
+
+    if (recorder && tick % captureInterval == 0)
+      recorder->capture(intersection);
+    tick++;
+
+    window.clear();
+    intersection.draw(window);
+    window.display();
   }
 
   return 0;